@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gamedef.h"
+#include "simulation.h"
+
+/**
+ * Micro and macro benchmarks of basesim.
+ *
+ * Usage: basesim_bench <gamefile> [--out file] [--baseline file] [--tolerance fraction] [--quick]
+ * Results are written as a flat json object of nanoseconds per operation, to stdout or --out.
+ * With --baseline every result has to be at most (1+tolerance) times its baseline, otherwise the exit code is 1.
+ * Baselines are machine specific, regenerate them with --out on the machine that checks them.
+ */
+
+namespace {
+    // keeps results alive so the compiler can not drop benchmarked calls
+    volatile double sink;
+
+    /**
+     * Best time of several repetitions of f, in nanoseconds per operation.
+     *
+     * @param ops operations done by one call of f
+     */
+    template<typename F>
+    double measure(const int repetitions, const double ops, F f) {
+        double best = 0;
+        for(int r=0; r<repetitions; r++) {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-start).count()/ops;
+            if(r == 0 || ns < best)
+                best = ns;
+        }
+        return best;
+    }
+
+    // Simulation in city level 2 with some buildings, so all parts of the hot path are used
+    Simulation lategame(const GameDef& def) {
+        Simulation sim(def, 20);
+        sim.progress = nullptr;
+        while(sim.citylevel < 2 && !sim.panic)
+            sim.runUntilReset(1e300);
+        for(int i=0; i<100000; i++)
+            sim.step();
+        return sim;
+    }
+
+    std::map<std::string, double> readBaseline(const std::string& filename) {
+        std::ifstream in(filename);
+        if(!in)
+            throw std::runtime_error("can not open baseline " + filename);
+        std::stringstream strs;
+        strs << in.rdbuf();
+        auto text = strs.str();
+        // flat object of "name": number, as written by writeJson
+        std::replace_if(text.begin(), text.end(), [](const char c) { return c == '{' || c == '}' || c == ',' || c == ':' || c == '"'; }, ' ');
+        std::istringstream values(text);
+        std::map<std::string, double> baseline;
+        std::string name;
+        double value;
+        while(values >> name >> value)
+            baseline[name] = value;
+        return baseline;
+    }
+
+    void writeJson(std::ostream& out, const std::map<std::string, double>& results) {
+        out << "{";
+        bool first = true;
+        for(const auto& r: results) {
+            out << (first ? "" : ",") << std::endl << "  \"" << r.first << "\": " << r.second;
+            first = false;
+        }
+        out << std::endl << "}" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        std::cerr << "usage: basesim_bench <gamefile> [--out file] [--baseline file] [--tolerance fraction] [--quick]" << std::endl;
+        return 2;
+    }
+    std::string out;
+    std::string baselinefile;
+    double tolerance = 0.25;
+    bool quick = false;
+    for(int i=2; i<argc; i++) {
+        const std::string arg = argv[i];
+        if(arg == "--out" && i+1 < argc)
+            out = argv[++i];
+        else if(arg == "--baseline" && i+1 < argc)
+            baselinefile = argv[++i];
+        else if(arg == "--tolerance" && i+1 < argc)
+            tolerance = std::stod(argv[++i]);
+        else if(arg == "--quick")
+            quick = true;
+        else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    try {
+        const auto def = GameDef::load(argv[1]);
+        const auto sim = lategame(def);
+        const int repetitions = quick ? 2 : 5;
+        const int n = quick ? 20000 : 200000;
+        std::map<std::string, double> results;
+
+        // micro benchmarks on the hot path
+        results["tickgain_ns"] = measure(repetitions, n, [&]() {
+            double d = 0;
+            for(int i=0; i<n; i++)
+                d += tickgain(sim.generators, sim.infrastructure, 0.5);
+            sink = d;
+        });
+
+        results["buy_ns"] = measure(repetitions, n, [&]() {
+            // nothing affordable, as in most ticks, so every call only picks
+            auto copy = sim;
+            double resource = 0;
+            bool bought = false;
+            for(int i=0; i<n; i++)
+                bought |= buy(copy.generators, copy.infrastructure, resource, i, 0);
+            sink = bought;
+        });
+
+        results["generator_eff_ns"] = measure(repetitions, n*sim.generators.size(), [&]() {
+            double d = 0;
+            for(int i=0; i<n; i++)
+                for(const auto& g: sim.generators)
+                    d += g.eff();
+            sink = d;
+        });
+
+        results["infrastructure_affmult_ns"] = measure(repetitions, n*sim.infrastructure.size()*sim.generators.size(), [&]() {
+            double d = 0;
+            for(int i=0; i<n; i++)
+                for(const auto& inf: sim.infrastructure)
+                    for(size_t g=0; g<sim.generators.size(); g++)
+                        d += inf.affmult(g);
+            sink = d;
+        });
+
+        results["reset_ns"] = measure(repetitions, n, [&]() {
+            auto copy = sim;
+            for(int i=0; i<n; i++) {
+                // a game has few runs, keep the run starts from growing so only the reset itself is measured
+                copy.runstarts.clear();
+                copy.newRun();
+            }
+            sink = copy.generators.back().boni;
+        });
+
+        // full simulations, in both numeric domains
+        for(const bool logmode: {false, true}) {
+            for(const double toexp: quick ? std::vector<double>{1e3} : std::vector<double>{1e3, 1e4, 1e5}) {
+                std::ostringstream name;
+                name << (logmode ? "simulate_log_" : "simulate_") << toexp << "_ns";
+                results[name.str()] = measure(quick ? 1 : 3, 1, [&]() {
+                    Simulation run(def, 20);
+                    run.progress = nullptr;
+                    run.setLogMode(logmode);
+                    run.run(toexp);
+                    sink = run.totalTicks();
+                });
+            }
+        }
+
+        if(out.empty()) {
+            writeJson(std::cout, results);
+        }else{
+            std::ofstream file(out);
+            writeJson(file, results);
+        }
+
+        if(baselinefile.empty())
+            return 0;
+
+        // regression check against the stored baseline
+        int regressions = 0;
+        for(const auto& b: readBaseline(baselinefile)) {
+            if(!results.count(b.first))
+                continue;
+            const auto current = results[b.first];
+            const bool slow = current > b.second*(1+tolerance);
+            regressions += slow;
+            std::cerr << (slow ? "SLOWER " : "ok     ") << b.first << ": " << current << " ns (baseline " << b.second << " ns)" << std::endl;
+        }
+        return regressions == 0 ? 0 : 1;
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+}
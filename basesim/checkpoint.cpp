@@ -0,0 +1,316 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <ios>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "checkpoint.h"
+#include "pool.h"
+
+namespace {
+    const std::string magic = "basesim-checkpoint";
+    const int version = 1;
+
+    /**
+     * Tokens of a checkpoint, every value is preceded by its key so files can be checked while reading.
+     */
+    class Reader {
+        std::ifstream in;
+        std::string filename;
+
+    public:
+        explicit Reader(const std::string& filename) : in(filename), filename(filename) {
+            if(!in)
+                throw std::runtime_error("can not open checkpoint " + filename);
+        }
+
+        [[noreturn]] void fail(const std::string& msg) const {
+            throw std::runtime_error("checkpoint " + filename + ": " + msg);
+        }
+
+        std::string token() {
+            std::string t;
+            if(!(in >> t))
+                fail("unexpected end of file");
+            return t;
+        }
+
+        void expect(const std::string& key) {
+            const auto t = token();
+            if(t != key)
+                fail("expected " + key + ", got " + t);
+        }
+
+        // istream can not read hexfloat, strtod can
+        double real() {
+            const auto t = token();
+            char* end;
+            const double d = std::strtod(t.c_str(), &end);
+            if(t.empty() || *end)
+                fail("malformed number " + t);
+            return d;
+        }
+
+        template<typename T>
+        T integer() {
+            const auto t = token();
+            char* end;
+            const auto v = std::strtoll(t.c_str(), &end, 10);
+            if(t.empty() || *end)
+                fail("malformed number " + t);
+            return (T)v;
+        }
+
+        uint64_t unsignedinteger() {
+            const auto t = token();
+            char* end;
+            const auto v = std::strtoull(t.c_str(), &end, 10);
+            if(t.empty() || *end)
+                fail("malformed number " + t);
+            return v;
+        }
+
+        std::vector<int> list() {
+            std::vector<int> v(integer<size_t>());
+            for(auto& i: v)
+                i = integer<int>();
+            return v;
+        }
+    };
+
+    /**
+     * Writes text to filename and flushes it to disk, then moves it over target.
+     * The move only happens once the data is on disk, so even a crash of the host leaves the old or the new file.
+     */
+    void writeDurably(const std::string& filename, const std::string& target, const std::string& text) {
+#ifdef _WIN32
+        const int fd = _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+        bool ok = fd >= 0 && _write(fd, text.data(), (unsigned)text.size()) == (int)text.size() && _commit(fd) == 0;
+        if(fd >= 0)
+            ok &= _close(fd) == 0;
+        if(!ok)
+            throw std::runtime_error("can not write checkpoint " + filename);
+        // rename fails if target exists on windows
+        if(!MoveFileExA(filename.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+            throw std::runtime_error("can not replace checkpoint " + target);
+#else
+        const int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool ok = fd >= 0;
+        for(size_t written = 0; ok && written < text.size();) {
+            const auto n = write(fd, text.data()+written, text.size()-written);
+            ok = n > 0;
+            written += ok ? n : 0;
+        }
+        ok = ok && fsync(fd) == 0;
+        if(fd >= 0)
+            ok &= close(fd) == 0;
+        if(!ok)
+            throw std::runtime_error("can not write checkpoint " + filename);
+        // rename replaces the old checkpoint atomically
+        if(std::rename(filename.c_str(), target.c_str()) != 0)
+            throw std::runtime_error("can not replace checkpoint " + target);
+        // and syncing the directory makes the rename itself durable
+        const auto slash = target.find_last_of('/');
+        const auto dir = slash == std::string::npos ? std::string(".") : target.substr(0, slash+1);
+        const int dirfd = open(dir.c_str(), O_RDONLY);
+        if(dirfd >= 0) {
+            fsync(dirfd);
+            close(dirfd);
+        }
+#endif
+    }
+
+    void writeList(std::ostream& out, const std::vector<int>& list) {
+        out << list.size();
+        for(auto i: list)
+            out << " " << i;
+    }
+}
+
+void saveCheckpoint(const Simulation& sim, const std::string& filename) {
+    std::ostringstream out;
+    out << std::hexfloat;
+    out << magic << " " << version << "\n";
+    out << "seed " << sim.seedValue() << "\n";
+    out << "policy " << sim.policy.resetlevel << " " << sim.policy.expfactor << " ";
+    writeList(out, sim.policy.research);
+    out << "\nresearch ";
+    writeList(out, sim.research);
+    out << "\ncitylevel " << sim.citylevel << "\n";
+    out << "exp " << sim.exp << "\n";
+    out << "locked " << sim.locked << "\n";
+    out << "research_mult " << sim.research_mult << "\n";
+    out << "resource " << sim.resource << "\n";
+    out << "allgain " << sim.allgain << "\n";
+    out << "inc " << sim.inc << "\n";
+    out << "logresource " << sim.logresource << "\n";
+    out << "logallgain " << sim.logallgain << "\n";
+    out << "ticks " << sim.ticks << "\n";
+    out << "allticks " << sim.allticks << "\n";
+    out << "resetindex " << sim.resetindex << "\n";
+    out << "held " << sim.held << "\n";
+    out << "panic " << sim.panic << "\n";
+    out << "logmode " << sim.logMode() << "\n";
+    out << "generators " << sim.generators.size() << "\n";
+    for(const auto& g: sim.generators)
+        out << g.level << " " << g.boni << " " << g.mult << "\n";
+    out << "infrastructure " << sim.infrastructure.size() << "\n";
+    for(const auto& inf: sim.infrastructure)
+        out << inf.level << "\n";
+    out << "resetlist " << sim.resetlist.size() << "\n";
+    for(auto ticks: sim.resetlist)
+        out << ticks << "\n";
+    out << "runstarts " << sim.runstarts.size() << "\n";
+    for(const auto& r: sim.runstarts)
+        out << r.exp << " " << r.citylevel << "\n";
+    out << "end\n";
+    writeDurably(filename + ".tmp", filename, out.str());
+}
+
+Simulation loadCheckpoint(const GameDef& def, const std::string& filename) {
+    Reader in(filename);
+    in.expect(magic);
+    if(in.integer<int>() != version)
+        in.fail("unsupported version");
+
+    in.expect("seed");
+    const auto seed = in.unsignedinteger();
+    Policy policy;
+    in.expect("policy");
+    policy.resetlevel = in.integer<long>();
+    policy.expfactor = in.real();
+    policy.research = in.list();
+
+    Simulation sim(def, 0, policy);
+    sim.progress = nullptr;
+    sim.seed(seed);
+    in.expect("research");
+    sim.research = in.list();
+    in.expect("citylevel");
+    sim.citylevel = in.integer<int>();
+    in.expect("exp");
+    sim.exp = in.real();
+    in.expect("locked");
+    sim.locked = in.real();
+    in.expect("research_mult");
+    sim.research_mult = in.real();
+    in.expect("resource");
+    sim.resource = in.real();
+    in.expect("allgain");
+    sim.allgain = in.real();
+    in.expect("inc");
+    sim.inc = in.real();
+    in.expect("logresource");
+    const double logresource = in.real();
+    in.expect("logallgain");
+    const double logallgain = in.real();
+    in.expect("ticks");
+    sim.ticks = in.unsignedinteger();
+    in.expect("allticks");
+    sim.allticks = in.real();
+    in.expect("resetindex");
+    sim.resetindex = in.unsignedinteger();
+    in.expect("held");
+    sim.held = in.integer<int>();
+    in.expect("panic");
+    sim.panic = in.integer<int>();
+    in.expect("logmode");
+    const bool logmode = in.integer<int>();
+
+    // buildings are rebuilt by buying them again, which restores costs, upgrades and logarithms exactly
+    in.expect("generators");
+    def.resetGenerators(sim.generators);
+    if(in.integer<size_t>() != sim.generators.size())
+        in.fail("generators do not match the game definition");
+    for(auto& g: sim.generators) {
+        const auto level = in.integer<long>();
+        g.boni = in.real();
+        g.mult = in.real();
+        for(long l=0; l<level; l++)
+            g.buy();
+    }
+    in.expect("infrastructure");
+    def.resetInfrastructure(sim.infrastructure, sim.citylevel, sim.research);
+    if(in.integer<size_t>() != sim.infrastructure.size())
+        in.fail("infrastructure does not match the game definition");
+    for(auto& inf: sim.infrastructure) {
+        const auto level = in.integer<long>();
+        for(long l=0; l<level; l++)
+            inf.buy();
+    }
+
+    in.expect("resetlist");
+    sim.resetlist.resize(in.integer<size_t>());
+    for(auto& ticks: sim.resetlist)
+        ticks = in.unsignedinteger();
+    in.expect("runstarts");
+    sim.runstarts.resize(in.integer<size_t>());
+    for(auto& r: sim.runstarts) {
+        r.exp = in.real();
+        r.citylevel = in.integer<int>();
+    }
+    in.expect("end");
+
+    // rebuilds the log cache, the stored logarithms replace the converted resources
+    sim.setLogMode(logmode);
+    sim.logresource = logresource;
+    sim.logallgain = logallgain;
+    return sim;
+}
+
+void runWithCheckpoints(Simulation& sim, const double toexp, const std::string& filename, const double interval) {
+    using clock = std::chrono::steady_clock;
+    auto saved = clock::now();
+    if(sim.held)
+        sim.newRun();
+    uint64_t steps = 0;
+    do{
+        sim.step();
+        if(sim.held)
+            break;
+        // the clock is only read every few thousand ticks, it is slower than a tick
+        if(++steps % 4096 == 0 && std::chrono::duration<double>(clock::now()-saved).count() >= interval) {
+            saveCheckpoint(sim, filename);
+            saved = clock::now();
+        }
+    }while(!sim.finished(toexp));
+    saveCheckpoint(sim, filename);
+}
+
+uint64_t replayRun(const GameDef& def, const Simulation& sim, const size_t index) {
+    if(index >= sim.resetlist.size() || index >= sim.runstarts.size())
+        throw std::out_of_range("run " + std::to_string(index) + " has not finished");
+    auto replay = Simulation::atRun(def, sim.policy, sim.seedValue(), index, sim.runstarts[index], sim.logMode());
+    replay.progress = nullptr;
+    replay.runUntilReset(INFINITY);
+    return replay.resetlist.empty() ? 0 : replay.resetlist.front();
+}
+
+std::vector<size_t> verifyRuns(const GameDef& def, const Simulation& sim, const unsigned threads) {
+    const auto runs = std::min(sim.resetlist.size(), sim.runstarts.size());
+    std::vector<uint64_t> replayed(runs);
+    {
+        // the pool finishes all runs before it is destroyed
+        WorkerPool pool(threads);
+        for(size_t i=0; i<runs; i++)
+            pool.submit([&, i]() { replayed[i] = replayRun(def, sim, i); });
+    }
+    std::vector<size_t> differing;
+    for(size_t i=0; i<runs; i++)
+        if(replayed[i] != sim.resetlist[i])
+            differing.push_back(i);
+    return differing;
+}
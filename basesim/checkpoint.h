@@ -0,0 +1,47 @@
+#include <string>
+#include <vector>
+
+#include "gamedef.h"
+#include "simulation.h"
+
+#ifndef IDLESIM_CHECKPOINT_H
+#define IDLESIM_CHECKPOINT_H
+
+/**
+ * Checkpoints and replays of long simulations.
+ *
+ * A checkpoint is a small text file with the full state of a simulation, doubles are written as hexfloat so a
+ * resumed simulation continues bit for bit. Generators and infrastructure are stored as their levels and rebuilt
+ * from the game definition, which has to be the same when loading.
+ */
+
+// Writes the state of sim to filename, through a synced temporary file so a crash never leaves a broken checkpoint
+void saveCheckpoint(const Simulation& sim, const std::string& filename);
+
+// Reads a checkpoint written by saveCheckpoint, throws std::runtime_error on malformed input
+Simulation loadCheckpoint(const GameDef& def, const std::string& filename);
+
+/**
+ * Simulation::run that saves a checkpoint every interval seconds and once at the end.
+ *
+ * @param interval seconds between checkpoints
+ */
+void runWithCheckpoints(Simulation& sim, double toexp, const std::string& filename, double interval);
+
+/**
+ * Simulates run index of sim again on its own, see Simulation::atRun.
+ * Uses the current policy of sim, so only runs that were simulated with that policy are reproduced.
+ *
+ * @return ticks of the replayed run at its reset
+ */
+uint64_t replayRun(const GameDef& def, const Simulation& sim, size_t index);
+
+/**
+ * Replays all finished runs of sim in parallel and compares them with its resetlist.
+ *
+ * @param threads 0 uses the hardware concurrency
+ * @return indices of the runs that differ
+ */
+std::vector<size_t> verifyRuns(const GameDef& def, const Simulation& sim, unsigned threads = 0);
+
+#endif //IDLESIM_CHECKPOINT_H
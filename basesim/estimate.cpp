@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "estimate.h"
+
+namespace {
+    /**
+     * Cached costs and multipliers of a run, only the bought building is recomputed on a purchase.
+     */
+    struct RunCache {
+        std::vector<double> gcost;
+        std::vector<double> geff;
+        std::vector<double> gmult;
+        std::vector<double> icost;
+
+        void rebuild(const Simulation& sim) {
+            gcost.clear();
+            geff.clear();
+            icost.clear();
+            for(const auto& g: sim.generators) {
+                gcost.push_back(g.cost());
+                geff.push_back(g.eff());
+            }
+            for(const auto& inf: sim.infrastructure)
+                icost.push_back(inf.cost());
+            rebuildMult(sim);
+        }
+
+        // multiplier of infrastructure per generator, as in tickgain
+        void rebuildMult(const Simulation& sim) {
+            gmult.assign(sim.generators.size(), 1.0);
+            for(size_t i=0; i<gmult.size(); i++)
+                for(const auto& inf: sim.infrastructure)
+                    gmult[i] *= inf.affmult(i);
+        }
+
+        // income per tick, same as tickgain
+        double income(const Simulation& sim, const double expmult) const {
+            double d = 0.1;
+            for(size_t i=0; i<gmult.size(); i++)
+                d += sim.generators[i].gain()*gmult[i];
+            return d*(1+expmult);
+        }
+    };
+}
+
+Estimate estimate(const Simulation& start, const double toexp, const double maxticks) {
+    Estimate e;
+
+    auto sim = start;
+    sim.progress = nullptr;
+    sim.metrics = nullptr;
+    sim.holdreset = false;
+    sim.setLogMode(false);
+    if(sim.held)
+        sim.newRun();
+
+    RunCache cache;
+    cache.rebuild(sim);
+    // ticks and purchases of the current run
+    double t = 0;
+    uint64_t purchases = 0;
+
+    while(!sim.finished(toexp)) {
+        if(e.ticks + t > maxticks) {
+            e.ticks += t;
+            e.purchases += purchases;
+            return e;
+        }
+
+        // same picks as buy: cheapest infrastructure first, otherwise the most efficient generator
+        size_t g = 0;
+        for(size_t i=1; i<cache.geff.size(); i++)
+            if(cache.geff[i] > cache.geff[g])
+                g = i;
+        size_t inf = 0;
+        for(size_t i=1; i<cache.icost.size(); i++)
+            if(cache.icost[i] < cache.icost[inf])
+                inf = i;
+        const bool hasinfra = !cache.icost.empty();
+        const double target = hasinfra ? std::min(cache.icost[inf], cache.gcost[g]) : cache.gcost[g];
+
+        // jump to the tick the purchase is affordable, in whole ticks like the simulation,
+        // which gains before it buys and buys at most once per tick, so resources overshoot the cost
+        const double inc = cache.income(sim, expmul(sim.exp, sim.locked));
+        const double ticks = std::max(1.0, std::ceil((target - sim.resource)/inc));
+        t += ticks;
+        sim.resource += ticks*inc;
+        sim.allgain += ticks*inc;
+        if(hasinfra && cache.icost[inf] <= sim.resource) {
+            sim.resource -= cache.icost[inf];
+            sim.infrastructure[inf].buy();
+            cache.icost[inf] = sim.infrastructure[inf].cost();
+            cache.rebuildMult(sim);
+        }else{
+            sim.resource -= cache.gcost[g];
+            sim.generators[g].buy();
+            cache.gcost[g] = sim.generators[g].cost();
+            cache.geff[g] = sim.generators[g].eff();
+        }
+        purchases++;
+
+        // same reset condition as the simulation, every event is a purchase
+        if(sim.generators.back().level>=sim.policy.resetlevel && expgain(sim.allgain) >= sim.policy.expfactor*sim.exp) {
+            // the simulation counts the ticks of a run from its first tick index, the purchase tick is the last one
+            sim.ticks += (uint64_t)t - 1;
+            e.ticks += sim.ticks;
+            sim.reset();
+            sim.newRun();
+            // as in step, the tick of the reset is tick 0 of the next run
+            sim.ticks = 1;
+            cache.rebuild(sim);
+
+            e.purchases += purchases;
+            e.resets++;
+            t = 0;
+            purchases = 0;
+        }
+    }
+
+    e.reached = true;
+    return e;
+}
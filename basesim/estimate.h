@@ -0,0 +1,43 @@
+#include <cstdint>
+#include <limits>
+
+#include "gamedef.h"
+#include "simulation.h"
+
+#ifndef IDLESIM_ESTIMATE_H
+#define IDLESIM_ESTIMATE_H
+
+/**
+ * Approximate outcome of a simulation, in ticks.
+ */
+struct Estimate {
+    // estimated ticks to reach toexp
+    double ticks = 0;
+    uint64_t resets = 0;
+    uint64_t purchases = 0;
+    // false if the estimate was stopped at maxticks
+    bool reached = false;
+};
+
+/**
+ * Estimates the ticks a simulation needs to reach toexp without stepping single ticks.
+ *
+ * Income is constant between purchases, so the estimate jumps from one purchase to the next: the ticks to the next
+ * purchase are the missing resource divided by the income, rounded up to whole ticks like the simulation, which
+ * keeps the overshoot above the cost. Purchases, resets and research use the same formulas and buy strategy as the
+ * tick simulation, so the estimate follows its purchase path.
+ * It is not exact: resources are gained as ticks*income instead of a sum of ticks, which rounds differently and
+ * can move a purchase by a tick. Usually that costs a tick or two per game, but a purchase that moves can also move
+ * a reset to another purchase, after which the paths differ, so there is no bound on the error.
+ * Random research draws come from the copied state, so the estimate follows the same draws as the simulation would.
+ *
+ * Stops as soon as the estimate exceeds maxticks.
+ *
+ * @param start state to estimate from, is not modified
+ * @param toexp target exp
+ * @param maxticks give up once the estimate is above this
+ * @return estimated ticks, counted from start
+ */
+Estimate estimate(const Simulation& start, double toexp, double maxticks = std::numeric_limits<double>::infinity());
+
+#endif //IDLESIM_ESTIMATE_H
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include "gamedef.h"
+
+namespace {
+    // infrastructure line as read from the file, choice -1 marks the default
+    struct InfraLine {
+        int citylevel;
+        int slot;
+        int choice;
+        Infrastrucutre infra;
+        // for errors on generators that are only known after the whole file is read
+        int line;
+        int highest;
+    };
+
+    [[noreturn]] void fail(const int line, const std::string& msg) {
+        throw std::runtime_error("game definition line " + std::to_string(line) + ": " + msg);
+    }
+
+    template<typename T>
+    T read(std::istringstream& in, const int line, const std::string& what) {
+        T value;
+        if(!(in >> value))
+            fail(line, "expected " + what);
+        return value;
+    }
+
+    template<typename T>
+    std::vector<T> readAll(std::istringstream& in, const int line, const std::string& what) {
+        std::vector<T> values;
+        T value;
+        while(in >> value)
+            values.push_back(value);
+        if(!in.eof())
+            fail(line, "malformed " + what);
+        return values;
+    }
+}
+
+GameDef GameDef::load(const std::string& filename) {
+    std::ifstream in(filename);
+    if(!in)
+        throw std::runtime_error("can not open game definition " + filename);
+    return load(in);
+}
+
+GameDef GameDef::load(std::istream& in) {
+    GameDef def;
+
+    // generator chain parameters
+    double bcost = 0, gcost = 0, bgain = 0, ggain = 0;
+    bool hasgenerators = false;
+    std::vector<double> costfactors;
+    std::vector<std::pair<int,Upgrade>> upgrades;
+    std::vector<InfraLine> infra;
+
+    std::string text;
+    for(int line = 1; std::getline(in, text); line++) {
+        text = text.substr(0, text.find('#'));
+        std::istringstream strs(text);
+        std::string key;
+        if(!(strs >> key))
+            continue;
+
+        if(key == "generators") {
+            bcost = read<double>(strs, line, "base cost");
+            gcost = read<double>(strs, line, "cost growth");
+            bgain = read<double>(strs, line, "base gain");
+            ggain = read<double>(strs, line, "gain growth");
+            hasgenerators = true;
+        }else if(key == "costfactors") {
+            costfactors = readAll<double>(strs, line, "cost factors");
+        }else if(key == "upgrade") {
+            const auto gen = read<int>(strs, line, "generator");
+            const auto level = read<int>(strs, line, "level");
+            const auto mult = read<double>(strs, line, "multiplier");
+            if(level < 1)
+                fail(line, "upgrade level has to be at least 1");
+            upgrades.push_back({gen, {level, mult, std::log(mult)}});
+        }else if(key == "research") {
+            def.researchcost = readAll<double>(strs, line, "research costs");
+        }else if(key == "citylevels") {
+            def.citylevels = readAll<double>(strs, line, "city level exp");
+        }else if(key == "infra") {
+            InfraLine l{0, 0, -1, Infrastrucutre(1, 0, 1, {}), line, -1};
+            l.citylevel = read<int>(strs, line, "city level");
+            l.slot = read<int>(strs, line, "slot");
+            const auto choice = read<std::string>(strs, line, "research choice");
+            if(choice != "*") {
+                l.choice = std::atoi(choice.c_str());
+                if(l.choice < 0 || l.choice >= variants || choice != std::to_string(l.choice))
+                    fail(line, "research choice has to be * or 0 to " + std::to_string(variants-1));
+            }
+            const auto costfactor = read<double>(strs, line, "cost factor");
+            const auto basecost = read<double>(strs, line, "base cost");
+            const auto basemult = read<double>(strs, line, "multiplier");
+            const auto affecting = readAll<int>(strs, line, "affected generators");
+            if(l.citylevel < 0 || l.slot < 0)
+                fail(line, "negative city level or slot");
+            for(auto a: affecting) {
+                if(a < 0 || a >= maxgenerators)
+                    fail(line, "affected generator out of range");
+                l.highest = std::max(l.highest, a);
+            }
+            l.infra = Infrastrucutre(costfactor, basecost, basemult, affecting);
+            infra.push_back(l);
+        }else{
+            fail(line, "unknown entry " + key);
+        }
+    }
+
+    if(!hasgenerators || costfactors.empty())
+        throw std::runtime_error("game definition needs generators and costfactors");
+    if(costfactors.size() > (size_t)maxgenerators)
+        throw std::runtime_error("game definition has more than " + std::to_string(maxgenerators) + " generators");
+    for(const auto& l: infra)
+        if(l.highest >= (int)costfactors.size())
+            fail(l.line, "affected generator " + std::to_string(l.highest) + " does not exist");
+
+    // flat upgrade table, grouped by generator and sorted by level
+    std::stable_sort(upgrades.begin(), upgrades.end(), [](const auto& u1, const auto& u2) {
+        return u1.first < u2.first || (u1.first == u2.first && u1.second.level < u2.second.level);
+    });
+    for(size_t i=0; i<upgrades.size(); i++) {
+        if(upgrades[i].first < 0 || upgrades[i].first >= (int)costfactors.size())
+            throw std::runtime_error("upgrade for unknown generator " + std::to_string(upgrades[i].first));
+        if(i>0 && upgrades[i].first == upgrades[i-1].first && upgrades[i].second.level == upgrades[i-1].second.level)
+            throw std::runtime_error("duplicate upgrade for generator " + std::to_string(upgrades[i].first));
+        def.upgrades.push_back(upgrades[i].second);
+    }
+
+    // template generators, same computation as the game does
+    double tgain = 1;
+    double tcost = 1;
+    auto u = def.upgrades.data();
+    auto up = upgrades.begin();
+    for(int i=0; i<(int)costfactors.size(); i++) {
+        auto g = Generator(costfactors[i], bcost*tcost, bgain*tgain);
+        auto first = u;
+        for(; up != upgrades.end() && up->first == i; ++up)
+            ++u;
+        g.setupdates(first, u);
+        def.generators.push_back(g);
+        tgain *= ggain;
+        tcost *= gcost;
+    }
+
+    // infrastructure slots, defaults fill all unset research variants
+    std::map<std::pair<int,int>, const InfraLine*> defaults;
+    for(const auto& l: infra) {
+        if(l.choice >= 0)
+            continue;
+        if(defaults.count({l.citylevel, l.slot}))
+            throw std::runtime_error("duplicate default infrastructure for city level " + std::to_string(l.citylevel));
+        defaults[{l.citylevel, l.slot}] = &l;
+    }
+    for(const auto& d: defaults) {
+        const auto citylevel = d.first.first;
+        const auto slot = d.first.second;
+        if((int)def.infrastructure.size() <= citylevel)
+            def.infrastructure.resize(citylevel+1);
+        auto& slots = def.infrastructure[citylevel];
+        if((int)slots.size() != slot)
+            throw std::runtime_error("infrastructure slots of city level " + std::to_string(citylevel) + " are not consecutive");
+        const auto& fb = d.second->infra;
+        slots.push_back({fb, {fb, fb, fb}});
+    }
+    for(const auto& l: infra) {
+        if(l.choice < 0)
+            continue;
+        if(!defaults.count({l.citylevel, l.slot}))
+            throw std::runtime_error("infrastructure variant without default for city level " + std::to_string(l.citylevel));
+        def.infrastructure[l.citylevel][l.slot].variant[l.choice] = l.infra;
+    }
+
+    return def;
+}
+
+void GameDef::resetGenerators(std::vector<Generator>& gens) const {
+    gens = generators;
+}
+
+void GameDef::resetInfrastructure(std::vector<Infrastrucutre>& infra, const int citylevel, const std::vector<int>& research) const {
+    infra.clear();
+    if(citylevel >= (int)infrastructure.size())
+        return;
+    const auto& slots = infrastructure[citylevel];
+    for(size_t i=0; i<slots.size(); i++) {
+        const auto r = i<research.size() ? research[i] : -1;
+        infra.push_back(r >= 0 && r < variants ? slots[i].variant[r] : slots[i].fallback);
+    }
+}
+
+size_t GameDef::maxInfrastructure() const {
+    size_t m = 0;
+    for(const auto& slots: infrastructure)
+        m = std::max(m, slots.size());
+    return m;
+}
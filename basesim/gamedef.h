@@ -0,0 +1,62 @@
+#include <array>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "generator.h"
+
+#ifndef IDLESIM_GAMEDEF_H
+#define IDLESIM_GAMEDEF_H
+
+/**
+ * Immutable definition of the game, loaded once from a game definition file (see cityidle.game).
+ *
+ * Holds flat tables of all upgrades and template generators/infrastructure with fresh state,
+ * so a reset only copies the templates back into the per run vectors and never allocates.
+ * Generators point into the upgrade table, so the definition can not be copied and has to outlive every run.
+ */
+class GameDef {
+public:
+    // research values that have their own infrastructure variant, others use the default
+    static constexpr int variants = 3;
+    // infrastructure keeps the generators it affects in a 32 bit mask
+    static constexpr int maxgenerators = 32;
+
+    // one infrastructure slot of a city level, with its alternatives chosen by research
+    struct InfraSlot {
+        Infrastrucutre fallback;
+        std::array<Infrastrucutre, variants> variant;
+    };
+
+    // all upgrades, grouped by generator and sorted by level
+    std::vector<Upgrade> upgrades;
+    // generators in their state after a reset
+    std::vector<Generator> generators;
+    // infrastructure slots per city level
+    std::vector<std::vector<InfraSlot>> infrastructure;
+    // exp cost of each research
+    std::vector<double> researchcost;
+    // exp needed to advance from city level i to i+1
+    std::vector<double> citylevels;
+
+    GameDef() = default;
+    GameDef(const GameDef&) = delete;
+    GameDef& operator=(const GameDef&) = delete;
+    GameDef(GameDef&&) = default;
+    GameDef& operator=(GameDef&&) = default;
+
+    // Parses a game definition, throws std::runtime_error on malformed input
+    static GameDef load(std::istream& in);
+    static GameDef load(const std::string& filename);
+
+    // Restores generators to their state after a reset
+    void resetGenerators(std::vector<Generator>& gens) const;
+
+    // Restores infrastructure for a city level with the given research choices, -1 is blocked research
+    void resetInfrastructure(std::vector<Infrastrucutre>& infra, int citylevel, const std::vector<int>& research) const;
+
+    // Most infrastructure slots of any city level, used to reserve per run vectors
+    size_t maxInfrastructure() const;
+};
+
+#endif //IDLESIM_GAMEDEF_H
@@ -3,7 +3,6 @@
 //
 #include <sstream>
 #include <cmath>
-#include <algorithm>
 
 #include "generator.h"
 
@@ -11,7 +10,8 @@ double gainFormula(double level, double basegain, double mult, double boni) {
     return level*basegain*mult*boni;
 }
 
-Generator::Generator(double costfactor, double basecost, double basegain) : costfactor(costfactor), basecost(basecost), basegain(basegain)  {
+Generator::Generator(double costfactor, double basecost, double basegain) : costfactor(costfactor), basecost(basecost), basegain(basegain),
+        logcostfactor(log(costfactor)), logbasecost(log(basecost)), logbasegain(log(basegain))  {
 
 }
 
@@ -25,8 +25,8 @@ double Generator::cost() const {
 
 double Generator::eff() const {
     auto tmpgain = basegain;
-    if(updates.count(level+1))
-        tmpgain *= updates.at(level+1);
+    if(next != last && next->level == level+1)
+        tmpgain *= next->mult;
     return gainFormula(level+1, tmpgain, mult, boni)/this->cost();
 }
 
@@ -38,17 +38,37 @@ std::string Generator::toString() const {
 
 void Generator::buy() {
     level++;
-    if(updates.count(level)>0){
-        basegain *= updates[level];
+    if(next != last && next->level == level){
+        basegain *= next->mult;
+        logbasegain += next->logmult;
+        ++next;
     }
 }
 
-void Generator::addupdate(int level, double mult) {
-    this->updates[level] = mult;
+double Generator::loggain() const {
+    return log(level) + logbasegain + log(mult*boni);
 }
 
-Infrastrucutre::Infrastrucutre(const double costfactor, const double basecost, const double basemult, std::initializer_list<int> affecting) : affecting(affecting), costfactor(costfactor), basecost(basecost), basemult(basemult) {
+double Generator::logcost() const {
+    return logbasecost + level*logcostfactor;
+}
+
+double Generator::logeff() const {
+    auto tmpgain = logbasegain;
+    if(next != last && next->level == level+1)
+        tmpgain += next->logmult;
+    return log(level+1) + tmpgain + log(mult*boni) - logcost();
+}
 
+void Generator::setupdates(const Upgrade* first, const Upgrade* last) {
+    this->next = first;
+    this->last = last;
+}
+
+Infrastrucutre::Infrastrucutre(const double costfactor, const double basecost, const double basemult, const std::vector<int>& affecting) : costfactor(costfactor), basecost(basecost), basemult(basemult),
+        logcostfactor(log(costfactor)), logbasecost(log(basecost)), logbasemult(log(basemult)) {
+    for(auto i: affecting)
+        this->affecting |= 1u << i;
 }
 
 double Infrastrucutre::mult() const {
@@ -67,6 +87,17 @@ void Infrastrucutre::buy() {
     this->level++;
 }
 
+double Infrastrucutre::logcost() const {
+    return logbasecost + level*logcostfactor;
+}
+
+double Infrastrucutre::logaffmult(int i) const {
+    if(affecting & (1u << i))
+        return level*logbasemult;
+    // Generator is not affecting this
+    return 0;
+}
+
 std::string Infrastrucutre::toString() const {
     std::ostringstream strs;
     strs << basecost << " -> " << basemult << " (" << costfactor << ")";
@@ -74,7 +105,7 @@ std::string Infrastrucutre::toString() const {
 }
 
 double Infrastrucutre::affmult(int i) const {
-    if(std::any_of(affecting.begin(), affecting.end(), [i](const auto element){ return i==element; }))
+    if(affecting & (1u << i))
         return mult();
     // Generator is not affecting this
     return 1;
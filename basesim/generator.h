@@ -1,22 +1,43 @@
 //
 // Created by david on 17.02.2019.
 //
+#include <cmath>
+#include <cstdint>
 #include <string>
-#include <map>
 #include <vector>
 
 #ifndef IDLESIM_GENERATOR_H
 #define IDLESIM_GENERATOR_H
 
+/**
+ * Upgrade of a generator, multiplies its gain when the level is reached.
+ */
+struct Upgrade {
+    int level;
+    double mult;
+    // log(mult), for the log domain
+    double logmult;
+};
+
 /**
  * Implements a generator of an idlegame, that produces resources per tick.
+ * Upgrades are not owned, they point into an immutable table (see GameDef) that has to outlive the generator.
+ * This keeps generators trivially copyable, so a reset is a plain copy of a template.
  */
 class Generator {
-    std::map<int,double> updates;
+    // upgrades sorted by level, next is the first one not applied yet
+    const Upgrade* next = nullptr;
+    const Upgrade* last = nullptr;
     double costfactor;
     double basecost;
     double basegain;
 
+    // logarithms for the log domain, costs are derived from the level so buy does not pay for the log domain
+    double logcostfactor;
+    double logbasecost;
+    // only changes on upgrades
+    double logbasegain;
+
 public:
     // Public as this is a private project and I believe I know that I am building a bikeshed
     long level = 0;
@@ -37,27 +58,42 @@ public:
     // efficiency is gain of next level divided by cost
     double eff() const;
 
+    // log(gain()), -inf at level 0
+    double loggain() const;
+
+    // log(cost()) without pow
+    double logcost() const;
+
+    // log(eff())
+    double logeff() const;
+
     // Increase level by one and apply possible upgrades
     void buy();
 
-    // Add an upgrade to this generator (Should be in Constructor, but too lazy)
-    void addupdate(int level, double mult);
+    // Set the upgrades of this generator, [first,last) has to be sorted by level
+    void setupdates(const Upgrade* first, const Upgrade* last);
 
     std::string toString() const;
 };
 
 class Infrastrucutre {
-    std::vector<int> affecting;
+    // bitmask of affected generators
+    uint32_t affecting = 0;
     double costfactor;
     double basecost;
     double basemult;
 
+    // logarithms for the log domain, costs are derived from the level so buy does not pay for the log domain
+    double logcostfactor;
+    double logbasecost;
+    double logbasemult;
+
 public:
     // Public as this is a private project and I believe I know that I am building a bikeshed
     long level = 0;
 
-    // cost is basecost*costfactor^level, gain mult basemult^level
-    Infrastrucutre(const double costfactor, const double basecost, const double basemult, std::initializer_list<int> affecting);
+    // cost is basecost*costfactor^level, gain mult basemult^level, affecting are generator indices below 32
+    Infrastrucutre(const double costfactor, const double basecost, const double basemult, const std::vector<int>& affecting);
 
     // mult = basegain*level
     double mult() const;
@@ -74,6 +110,12 @@ public:
     // Returns multiplier for a given generator
     double affmult(int i) const;
 
+    // log(cost()) without pow
+    double logcost() const;
+
+    // log(affmult(i))
+    double logaffmult(int i) const;
+
     std::string toString() const;
 };
 
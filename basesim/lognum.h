@@ -0,0 +1,29 @@
+#include <cmath>
+
+#ifndef IDLESIM_LOGNUM_H
+#define IDLESIM_LOGNUM_H
+
+/**
+ * Arithmetic on logarithms of non negative values, log(0) is -inf.
+ * Used by the log domain of the simulation, where resources far beyond the range of a double stay finite.
+ */
+
+// log(exp(a)+exp(b))
+inline double logadd(const double a, const double b) {
+    if(a < b)
+        return logadd(b, a);
+    if(b == -INFINITY)
+        return a;
+    return a + std::log1p(std::exp(b-a));
+}
+
+// log(exp(a)-exp(b)), needs b <= a
+inline double logsub(const double a, const double b) {
+    if(b >= a)
+        return -INFINITY;
+    if(b == -INFINITY)
+        return a;
+    return a + std::log1p(-std::exp(b-a));
+}
+
+#endif //IDLESIM_LOGNUM_H
@@ -0,0 +1,45 @@
+#include "metrics.h"
+
+namespace {
+    double seconds(const uint64_t ns) {
+        return ns/1e9;
+    }
+
+    double since(const SimMetrics::clock::time_point start) {
+        return std::chrono::duration<double>(SimMetrics::clock::now()-start).count();
+    }
+}
+
+void SimMetrics::startRun() {
+    runstart = clock::now();
+    resetstart = runstart;
+}
+
+void SimMetrics::recordReset(const double exp, const uint64_t ticks) {
+    resets.push_back({exp, ticks, since(resetstart)});
+    resetstart = clock::now();
+}
+
+void SimMetrics::endRun() {
+    totalns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now()-runstart).count();
+}
+
+void SimMetrics::writeJson(std::ostream& out) const {
+    const auto total = seconds(totalns);
+    out << "{" << std::endl;
+    out << "  \"ticks\": " << ticks << "," << std::endl;
+    out << "  \"seconds\": " << total << "," << std::endl;
+    out << "  \"ticks_per_second\": " << (total>0 ? ticks/total : 0) << "," << std::endl;
+    out << "  \"buy_calls\": " << buycalls << "," << std::endl;
+    out << "  \"purchases\": " << purchases << "," << std::endl;
+    out << "  \"tickgain_seconds\": " << seconds(tickgainns) << "," << std::endl;
+    out << "  \"buy_seconds\": " << seconds(buyns) << "," << std::endl;
+    out << "  \"reset_seconds\": " << seconds(resetns) << "," << std::endl;
+    out << "  \"resets\": [";
+    for(size_t i=0; i<resets.size(); i++) {
+        out << (i ? "," : "") << std::endl;
+        out << "    {\"exp\": " << resets[i].exp << ", \"ticks\": " << resets[i].ticks << ", \"seconds\": " << resets[i].seconds << "}";
+    }
+    out << std::endl << "  ]" << std::endl;
+    out << "}" << std::endl;
+}
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#ifndef IDLESIM_METRICS_H
+#define IDLESIM_METRICS_H
+
+/**
+ * Run metrics of the simulation hot path.
+ * Only collected when compiled with -DBASESIM_METRICS, otherwise the METRICS_* macros expand to nothing
+ * and the simulation pays nothing for them.
+ */
+
+// Stats for a single reset (one run from reset to reset)
+struct ResetMetrics {
+    double exp;
+    uint64_t ticks;
+    double seconds;
+};
+
+struct SimMetrics {
+    using clock = std::chrono::steady_clock;
+
+    uint64_t ticks = 0;
+    uint64_t buycalls = 0;
+    uint64_t purchases = 0;
+
+    // accumulated nanoseconds spent in the respective part of the loop
+    uint64_t tickgainns = 0;
+    uint64_t buyns = 0;
+    uint64_t resetns = 0;
+    uint64_t totalns = 0;
+
+    std::vector<ResetMetrics> resets;
+
+    // Marks start of a simulation, also starts the first reset
+    void startRun();
+
+    // Records a reset that gained exp after ticks, duration is measured since the last reset
+    void recordReset(double exp, uint64_t ticks);
+
+    // Marks end of a simulation
+    void endRun();
+
+    // Writes a json summary of all counters and the per reset list
+    void writeJson(std::ostream& out) const;
+
+private:
+    clock::time_point runstart;
+    clock::time_point resetstart;
+};
+
+/**
+ * Adds the time between construction and destruction to target, if target is set.
+ */
+class MetricsTimer {
+    uint64_t* target;
+    SimMetrics::clock::time_point start;
+
+public:
+    // the clock is only read with a target, so unmetered simulations pay nothing for it
+    explicit MetricsTimer(uint64_t* target) : target(target) {
+        if(target)
+            start = SimMetrics::clock::now();
+    }
+    ~MetricsTimer() {
+        if(target)
+            *target += std::chrono::duration_cast<std::chrono::nanoseconds>(SimMetrics::clock::now()-start).count();
+    }
+};
+
+// All macros take a SimMetrics pointer, which may be null
+#ifdef BASESIM_METRICS
+#define METRICS_ADD(m, field, value) do { if(m) (m)->field += (value); } while(0)
+#define METRICS_CALL(m, call) do { if(m) (m)->call; } while(0)
+#define METRICS_TIME(m, field) MetricsTimer metricstimer_##field((m) ? &(m)->field : nullptr)
+#else
+#define METRICS_ADD(m, field, value) do {} while(0)
+#define METRICS_CALL(m, call) do {} while(0)
+#define METRICS_TIME(m, field) do {} while(0)
+#endif
+
+#endif //IDLESIM_METRICS_H
@@ -0,0 +1,43 @@
+#include <algorithm>
+
+#include "pool.h"
+
+WorkerPool::WorkerPool(unsigned threads) {
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned t=0; t<threads; t++)
+        workers.emplace_back([this]() { work(); });
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for(auto& w: workers)
+        w.join();
+}
+
+void WorkerPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs.push_back(std::move(job));
+    }
+    wakeup.notify_one();
+}
+
+void WorkerPool::work() {
+    for(;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wakeup.wait(guard, [this]() { return stopping || !jobs.empty(); });
+            if(jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
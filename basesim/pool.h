@@ -0,0 +1,37 @@
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef IDLESIM_POOL_H
+#define IDLESIM_POOL_H
+
+/**
+ * Fixed set of worker threads that run submitted jobs in submission order until the pool is destroyed.
+ */
+class WorkerPool {
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex lock;
+    std::condition_variable wakeup;
+    bool stopping = false;
+
+    void work();
+
+public:
+    // threads 0 uses the hardware concurrency
+    explicit WorkerPool(unsigned threads = 0);
+    // Finishes all queued jobs, then joins the workers
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void submit(std::function<void()> job);
+
+    size_t size() const { return workers.size(); }
+};
+
+#endif //IDLESIM_POOL_H
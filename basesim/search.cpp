@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+
+#include "estimate.h"
+#include "search.h"
+
+namespace {
+    struct Branch {
+        Simulation sim;
+        std::vector<int> choices;
+    };
+
+    // Calls f(i) for all i<n on a number of threads
+    template<typename F>
+    void parallelFor(const size_t n, unsigned threads, F f) {
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+            for(size_t i = next++; i < n; i = next++)
+                f(i);
+        };
+        threads = std::min<size_t>(threads, n);
+        std::vector<std::thread> pool;
+        for(unsigned t=1; t<threads; t++)
+            pool.emplace_back(work);
+        work();
+        for(auto& t: pool)
+            t.join();
+    }
+}
+
+std::vector<SearchResult> searchPolicies(const GameDef& def, const std::vector<Policy>& candidates, const int depth, const double toexp, const double startexp, unsigned threads, const double prune) {
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    Simulation root(def, startexp);
+    root.progress = nullptr;
+    root.holdreset = true;
+    std::vector<Branch> frontier = {{root, {}}};
+
+    for(int d=0; d<depth && !candidates.empty(); d++) {
+        // fork every unfinished branch at its decision point, finished ones are carried over
+        std::vector<Branch> next;
+        std::vector<size_t> forked;
+        for(auto& b: frontier) {
+            if(b.sim.finished(toexp)) {
+                next.push_back(std::move(b));
+                continue;
+            }
+            for(size_t c=0; c<candidates.size(); c++) {
+                forked.push_back(next.size());
+                next.push_back(b);
+                next.back().sim.policy = candidates[c];
+                next.back().choices.push_back(c);
+            }
+        }
+        frontier = std::move(next);
+
+        // advance the new branches to their next decision
+        parallelFor(forked.size(), threads, [&](const size_t i) {
+            frontier[forked[i]].sim.runUntilReset(toexp);
+        });
+    }
+
+    // estimate the rest of every leaf, only leaves within prune of the best estimate are finished
+    std::vector<Estimate> estimates(frontier.size());
+    std::vector<bool> pruned(frontier.size(), false);
+    if(prune > 0) {
+        parallelFor(frontier.size(), threads, [&](const size_t i) {
+            estimates[i] = estimate(frontier[i].sim, toexp);
+        });
+        double best = std::numeric_limits<double>::infinity();
+        for(size_t i=0; i<frontier.size(); i++)
+            best = std::min(best, frontier[i].sim.totalTicks() + estimates[i].ticks);
+        for(size_t i=0; i<frontier.size(); i++)
+            pruned[i] = frontier[i].sim.totalTicks() + estimates[i].ticks > best*(1+prune);
+    }
+
+    // finish all branches with their last policy
+    parallelFor(frontier.size(), threads, [&](const size_t i) {
+        auto& sim = frontier[i].sim;
+        sim.holdreset = false;
+        if(!pruned[i] && !sim.finished(toexp))
+            sim.run(toexp);
+    });
+
+    std::vector<SearchResult> results;
+    for(size_t i=0; i<frontier.size(); i++) {
+        const auto& sim = frontier[i].sim;
+        const uint64_t ticks = pruned[i] ? sim.totalTicks() + estimates[i].ticks : sim.totalTicks();
+        results.push_back({frontier[i].choices, sim.resetlist, ticks, sim.panic, pruned[i]});
+    }
+    std::stable_sort(results.begin(), results.end(), [](const auto& r1, const auto& r2) {
+        if(r1.pruned != r2.pruned)
+            return r2.pruned;
+        return r1.panic < r2.panic || (r1.panic == r2.panic && r1.ticks < r2.ticks);
+    });
+    return results;
+}
@@ -0,0 +1,47 @@
+#include <cstdint>
+#include <vector>
+
+#include "gamedef.h"
+#include "simulation.h"
+
+#ifndef IDLESIM_SEARCH_H
+#define IDLESIM_SEARCH_H
+
+/**
+ * Outcome of one branch of a policy search.
+ */
+struct SearchResult {
+    // index of the candidate policy picked at each decision
+    std::vector<int> choices;
+    // ticks of each run at its reset
+    std::vector<uint64_t> resetlist;
+    uint64_t ticks;
+    bool panic;
+    // not simulated to the end as its estimate could not beat the best branch, ticks are estimated
+    bool pruned;
+};
+
+/**
+ * Searches a tree of reset policies.
+ * Decision d picks one of the candidates for run d, the policy decides the research of that run and when it ends in a reset.
+ * After depth decisions each branch keeps its last policy until toexp is reached.
+ *
+ * Branches are forked from a copy of the state at their decision point instead of being replayed from tick 0,
+ * so all branches share their common prefix and the search costs roughly the sum of the unique suffixes.
+ * Branches of the same depth run in parallel.
+ * With prune, the remaining ticks of every leaf are estimated first (see estimate.h) and leaves estimated more than
+ * prune (relative) above the best estimate are not simulated to the end. This is a heuristic: estimates have no
+ * error bound, so a tolerance that is too small can drop the branch that is actually best. It is off by default.
+ *
+ * @param def game definition
+ * @param candidates policies to pick from at every decision
+ * @param depth number of decisions
+ * @param toexp target exp of every branch
+ * @param startexp start exp
+ * @param threads worker threads, 0 uses the hardware concurrency
+ * @param prune relative tolerance for skipping leaves by their estimate, 0 simulates all leaves
+ * @return results of all branches, fastest first, pruned ones last
+ */
+std::vector<SearchResult> searchPolicies(const GameDef& def, const std::vector<Policy>& candidates, int depth, double toexp, double startexp = 0, unsigned threads = 0, double prune = 0);
+
+#endif //IDLESIM_SEARCH_H
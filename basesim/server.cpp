@@ -0,0 +1,288 @@
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "estimate.h"
+#include "pool.h"
+#include "server.h"
+
+namespace {
+    std::string quote(const std::string& s) {
+        std::ostringstream strs;
+        strs << '"';
+        for(const char c: s) {
+            if(c == '"' || c == '\\')
+                strs << '\\' << c;
+            else if((unsigned char)c < 0x20)
+                strs << ' ';
+            else
+                strs << c;
+        }
+        strs << '"';
+        return strs.str();
+    }
+
+    /**
+     * Scenarios of one input, results are written back in completion order.
+     */
+    class Session {
+        const GameDef& def;
+        WorkerPool& pool;
+        std::function<void(const std::string&)> write;
+        std::mutex lock;
+        std::condition_variable finished;
+        size_t pending = 0;
+        size_t lines = 0;
+
+    public:
+        Session(const GameDef& def, WorkerPool& pool, std::function<void(const std::string&)> write) : def(def), pool(pool), write(std::move(write)) {}
+
+        void submit(const std::string& line) {
+            lines++;
+            const auto start = line.find_first_not_of(" \t\r");
+            if(start == std::string::npos || line[start] == '#')
+                return;
+            const auto number = lines;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                pending++;
+            }
+            pool.submit([this, line, number]() {
+                std::string result;
+                Scenario scenario;
+                scenario.id = std::to_string(number);
+                try {
+                    scenario = parseScenario(line);
+                    if(scenario.id.empty())
+                        scenario.id = std::to_string(number);
+                    result = runScenario(def, scenario);
+                } catch(const std::exception& e) {
+                    result = "{\"id\": " + quote(scenario.id) + ", \"error\": " + quote(e.what()) + "}";
+                }
+                std::lock_guard<std::mutex> guard(lock);
+                write(result + "\n");
+                pending--;
+                finished.notify_all();
+            });
+        }
+
+        // Blocks until all submitted scenarios are written
+        void wait() {
+            std::unique_lock<std::mutex> guard(lock);
+            finished.wait(guard, [this]() { return pending == 0; });
+        }
+    };
+}
+
+Scenario parseScenario(const std::string& line) {
+    Scenario scenario;
+    std::istringstream strs(line);
+    std::string token;
+    while(strs >> token) {
+        const auto eq = token.find('=');
+        if(eq == std::string::npos)
+            throw std::runtime_error("expected key=value, got " + token);
+        const auto key = token.substr(0, eq);
+        const auto value = token.substr(eq+1);
+        try {
+            if(key == "id") {
+                scenario.id = value;
+            }else if(key == "toexp") {
+                scenario.toexp = std::stod(value);
+            }else if(key == "startexp") {
+                scenario.startexp = std::stod(value);
+            }else if(key == "resetlevel") {
+                scenario.policy.resetlevel = std::stol(value);
+            }else if(key == "expfactor") {
+                scenario.policy.expfactor = std::stod(value);
+            }else if(key == "research") {
+                scenario.policy.research.clear();
+                std::istringstream list(value);
+                std::string r;
+                while(std::getline(list, r, ','))
+                    scenario.policy.research.push_back(std::stoi(r));
+            }else if(key == "seed") {
+                scenario.seed = std::stoull(value);
+                scenario.seeded = true;
+            }else if(key == "mode") {
+                if(value != "exact" && value != "estimate")
+                    throw std::runtime_error("mode has to be exact or estimate");
+                scenario.estimate = value == "estimate";
+            }else if(key == "maxticks") {
+                scenario.maxticks = std::stod(value);
+                if(!(scenario.maxticks > 0))
+                    throw std::runtime_error("maxticks has to be positive");
+            }else if(key == "numeric") {
+                if(value != "double" && value != "log")
+                    throw std::runtime_error("numeric has to be double or log");
+                scenario.logmode = value == "log";
+            }else{
+                throw std::runtime_error("unknown key " + key);
+            }
+        } catch(const std::logic_error&) {
+            // stod and friends throw invalid_argument or out_of_range
+            throw std::runtime_error("malformed value for " + key + ": " + value);
+        }
+    }
+    return scenario;
+}
+
+std::string runScenario(const GameDef& def, const Scenario& scenario) {
+    const auto start = std::chrono::steady_clock::now();
+    Simulation sim(def, scenario.startexp, scenario.policy);
+    sim.progress = nullptr;
+    if(scenario.seeded)
+        sim.seed(scenario.seed);
+    sim.setLogMode(scenario.logmode);
+
+    std::ostringstream strs;
+    strs.precision(10);
+    strs << "{\"id\": " << quote(scenario.id);
+    if(scenario.estimate) {
+        const auto e = estimate(sim, scenario.toexp, scenario.maxticks > 0 ? scenario.maxticks : Scenario::estimatemaxticks);
+        strs << ", \"mode\": \"estimate\", \"reached\": " << (e.reached ? "true" : "false");
+        strs << ", \"ticks\": " << e.ticks;
+        strs << ", \"resets\": " << e.resets << ", \"purchases\": " << e.purchases;
+    }else{
+        // as Simulation::run, but stops at the tick limit
+        const double maxticks = scenario.maxticks > 0 ? scenario.maxticks : Scenario::exactmaxticks;
+        double steps = 0;
+        do{
+            sim.step();
+        }while(!sim.finished(scenario.toexp) && ++steps < maxticks);
+        strs << ", \"mode\": \"exact\", \"reached\": " << (sim.exp >= scenario.toexp ? "true" : "false");
+        strs << ", \"ticks\": " << sim.totalTicks() << ", \"resets\": " << sim.resetlist.size();
+        strs << ", \"panic\": " << (sim.panic ? "true" : "false") << ", \"resetlist\": [";
+        for(size_t i=0; i<sim.resetlist.size(); i++)
+            strs << (i ? ", " : "") << sim.resetlist[i];
+        strs << "]";
+    }
+    strs << ", \"seconds\": " << std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count() << "}";
+    return strs.str();
+}
+
+int serveStream(const GameDef& def, std::istream& in, std::ostream& out, const unsigned threads) {
+    WorkerPool pool(threads);
+    Session session(def, pool, [&out](const std::string& result) {
+        out << result << std::flush;
+    });
+    std::string line;
+    while(std::getline(in, line))
+        session.submit(line);
+    session.wait();
+    return 0;
+}
+
+#ifdef _WIN32
+int serveSocket(const GameDef&, const std::string&, unsigned) {
+    std::cerr << "socket mode is not supported on windows, use the batch mode on stdin" << std::endl;
+    return 1;
+}
+#else
+int serveSocket(const GameDef& def, const std::string& path, const unsigned threads) {
+    sockaddr_un addr{};
+    if(path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "socket path too long: " << path << std::endl;
+        return 1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+
+    // a stale socket of an earlier server is replaced, anything else at path is left alone
+    struct stat st;
+    if(lstat(path.c_str(), &st) == 0) {
+        if(!S_ISSOCK(st.st_mode)) {
+            std::cerr << path << " exists and is not a socket" << std::endl;
+            return 1;
+        }
+        // only a socket nobody listens on any more is stale
+        const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        const bool refused = probe >= 0 && connect(probe, (sockaddr*)&addr, sizeof(addr)) < 0 && errno == ECONNREFUSED;
+        if(probe >= 0)
+            close(probe);
+        if(!refused) {
+            std::cerr << path << " is already in use" << std::endl;
+            return 1;
+        }
+        unlink(path.c_str());
+    }
+
+    const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(server < 0 || bind(server, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(server, 16) < 0) {
+        std::cerr << "can not listen on " << path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // the pool is shared by all connections, each connection is read by its own thread
+    WorkerPool pool(threads);
+    // open connections, the pool has to outlive their threads
+    std::mutex connectionlock;
+    std::condition_variable closed;
+    size_t connections = 0;
+    for(;;) {
+        const int client = accept(server, nullptr, nullptr);
+        if(client < 0) {
+            if(errno == EINTR)
+                continue;
+            std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> guard(connectionlock);
+            connections++;
+        }
+        std::thread([&, client]() {
+            // the session is gone before the connection counts as closed
+            {
+                Session session(def, pool, [client](const std::string& result) {
+                    for(size_t sent = 0; sent < result.size();) {
+                        const auto n = send(client, result.data()+sent, result.size()-sent, MSG_NOSIGNAL);
+                        if(n <= 0)
+                            return;
+                        sent += n;
+                    }
+                });
+                std::string buffer;
+                char chunk[4096];
+                for(;;) {
+                    const auto n = read(client, chunk, sizeof(chunk));
+                    if(n < 0 && errno == EINTR)
+                        continue;
+                    if(n <= 0)
+                        break;
+                    buffer.append(chunk, n);
+                    for(auto nl = buffer.find('\n'); nl != std::string::npos; nl = buffer.find('\n')) {
+                        session.submit(buffer.substr(0, nl));
+                        buffer.erase(0, nl+1);
+                    }
+                }
+                if(!buffer.empty())
+                    session.submit(buffer);
+                session.wait();
+                close(client);
+            }
+            std::lock_guard<std::mutex> guard(connectionlock);
+            connections--;
+            closed.notify_all();
+        }).detach();
+    }
+    close(server);
+    std::unique_lock<std::mutex> guard(connectionlock);
+    closed.wait(guard, [&]() { return connections == 0; });
+    unlink(path.c_str());
+    return 1;
+}
+#endif
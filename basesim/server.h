@@ -0,0 +1,53 @@
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "gamedef.h"
+#include "simulation.h"
+
+#ifndef IDLESIM_SERVER_H
+#define IDLESIM_SERVER_H
+
+/**
+ * Batch mode of basesim: scenarios are read one per line, simulated on a persistent worker pool
+ * and one json line per scenario is written back as soon as it is finished, so in completion order.
+ *
+ * A scenario line is a list of key=value pairs, all optional:
+ *   id=<name> toexp=<exp> startexp=<exp> resetlevel=<level> expfactor=<factor> research=<r0,r1,...> seed=<seed>
+ *   mode=<exact|estimate> numeric=<double|log> maxticks=<ticks>
+ * maxticks limits the simulated ticks, so scenarios that never reset or never reach toexp still finish with
+ * "reached": false. Estimates are cheap per tick, so their default limit is much higher.
+ * Empty lines and lines starting with # are skipped, malformed lines produce a result with an error.
+ */
+struct Scenario {
+    std::string id;
+    double toexp = 1000000000;
+    double startexp = 20;
+    Policy policy;
+    // research draws use the default seed if not set
+    bool seeded = false;
+    uint64_t seed = 0;
+    // estimate (see estimate.h) instead of an exact simulation
+    bool estimate = false;
+    // simulate in the log domain, see Simulation::setLogMode
+    bool logmode = false;
+    // limit of simulated ticks, 0 uses the default of the mode
+    double maxticks = 0;
+
+    static constexpr double exactmaxticks = 1e9;
+    static constexpr double estimatemaxticks = 1e13;
+};
+
+// Parses a scenario line, throws std::runtime_error on malformed input
+Scenario parseScenario(const std::string& line);
+
+// Runs a scenario and returns its result as a single json line without newline
+std::string runScenario(const GameDef& def, const Scenario& scenario);
+
+// Serves scenarios from in until eof, results go to out
+int serveStream(const GameDef& def, std::istream& in, std::ostream& out, unsigned threads = 0);
+
+// Serves scenarios from every connection to a unix socket at path, results go back to the connection
+int serveSocket(const GameDef& def, const std::string& path, unsigned threads = 0);
+
+#endif //IDLESIM_SERVER_H
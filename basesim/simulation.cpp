@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "simulation.h"
+
+/**
+ * Calculate part of the expgain and mult functions
+ *
+ * @param z
+ * @return exp(log/loglog)
+ */
+double calcstuff(const double z) {
+    return exp(log(z)/log(log(z)));
+}
+
+/**
+ * computes multiplier from experience value
+ *
+ * @param experience
+ * @return mulitplier
+ */
+double expmul(const double experience, const double lockedexp) {
+    const double effexp = experience-lockedexp;
+    if(effexp<=0) return 0;
+    double sig = effexp / 1000.0;
+    if(sig>1) sig = 1;
+    return ((1-sig)* 0.04 * effexp + sig* calcstuff(effexp));
+}
+
+/**
+ * computes gain of experience for give resource value
+ *
+ * @param gained
+ * @return experience gained
+ */
+double expgain(const double gained) {
+    double sig1 = gained / 200000000000000000000.0;
+    double sig2 = (gained-2000000000000) / 200000000000000000000.0;
+    if(sig1>1) sig1 = 1;
+    if(sig2>1) sig2 = 1;
+    if(sig2<0) sig2 = 0;
+    double precalc = gained / (1LL<<33);
+    return (1-sig1)*sqrt(precalc)+sig2*calcstuff(gained);
+}
+
+namespace {
+    // splitmix64 finalizer
+    uint64_t mix(uint64_t z) {
+        z += 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // rate of the exponential research draw
+    const double researchrate = 0.02;
+}
+
+double uniformDraw(const uint64_t seed, const uint64_t stream, const uint64_t counter) {
+    const uint64_t h = mix(mix(mix(seed) ^ stream) ^ counter);
+    // 53 random bits, shifted by half a step to exclude 0 and 1
+    return ((h >> 11) + 0.5) / 9007199254740992.0;
+}
+
+double logexpgain(const double loggained) {
+    // beyond 1e300 both sigmoids of expgain are saturated, only calcstuff is left
+    if(loggained < 690)
+        return expgain(exp(loggained));
+    return exp(loggained/log(loggained));
+}
+
+Simulation::Simulation(const GameDef& def, const double startexp, Policy policy) : def(&def), policy(std::move(policy)), exp(startexp) {
+    infrastructure.reserve(def.maxInfrastructure());
+    research = this->policy.research;
+    def.resetGenerators(generators);
+    def.resetInfrastructure(infrastructure, citylevel, research);
+    runstarts.push_back({exp, citylevel});
+}
+
+Simulation Simulation::atRun(const GameDef& def, const Policy& policy, const uint64_t seed, const uint64_t index, const RunStart& start, const bool logmode) {
+    Simulation sim(def, start.exp, policy);
+    sim.seed(seed);
+    sim.citylevel = start.citylevel;
+    sim.resetindex = index;
+    sim.runstarts.clear();
+    if(index == 0) {
+        // the first run applies no research, as in the constructor
+        def.resetInfrastructure(sim.infrastructure, sim.citylevel, sim.research);
+        sim.runstarts.push_back(start);
+    }else{
+        sim.newRun();
+        // runs after a reset start at tick 1, the reset tick counts as tick 0
+        sim.ticks = 1;
+    }
+    sim.setLogMode(logmode);
+    return sim;
+}
+
+bool Simulation::step() {
+    bool bought;
+    if(logmode){
+        // income is cached, it only changes on purchases
+        {
+            METRICS_TIME(metrics, tickgainns);
+            logresource = logadd(logresource, loginc);
+            logallgain = logadd(logallgain, loginc);
+        }
+        {
+            METRICS_TIME(metrics, buyns);
+            bought = buyLog();
+        }
+    }else{
+        if(resource<0){
+            if(progress) *progress << "PANIC" << std::endl;
+            panic = true;
+            return false;
+        }
+
+        // compute income for this round
+        auto expmult =  expmul(exp,locked);
+        {
+            METRICS_TIME(metrics, tickgainns);
+            inc = tickgain(generators, infrastructure,expmult);
+        }
+        resource += inc;
+        allgain += inc;
+
+        // buy new generators
+        {
+            METRICS_TIME(metrics, buyns);
+            bought = buy(generators, infrastructure, resource, ticks, inc);
+        }
+    }
+    METRICS_ADD(metrics, ticks, 1);
+    METRICS_ADD(metrics, buycalls, 1);
+    METRICS_ADD(metrics, purchases, bought);
+
+    // reset if possible and we gain at least previous exp amount
+    const bool doreset = generators.back().level>=policy.resetlevel && expGained() >= policy.expfactor*exp && bought;
+    if(doreset){
+        METRICS_TIME(metrics, resetns);
+        reset();
+        if(holdreset)
+            held = true;
+        else
+            newRun();
+    }
+
+    // stop if condition for soft reset is met
+    ticks++;
+    return doreset;
+}
+
+void Simulation::reset() {
+    // log on reset
+    resetlist.push_back(ticks);
+
+    // gain experience
+    const auto gained = expGained();
+    exp += gained;
+    METRICS_CALL(metrics, recordReset(gained, ticks));
+
+    if((size_t)citylevel < def->citylevels.size() && exp >= def->citylevels[citylevel]){
+        citylevel += 1;
+        exp = 0;
+        if(progress) *progress << "!";
+    }else{
+        // print dot for progress
+        if(progress) *progress << ".";
+    }
+
+    // reset non exp stats
+    resource = 0;
+    allgain = 0;
+    logresource = -INFINITY;
+    logallgain = -INFINITY;
+
+    // we measure play length per run
+    allticks += ticks;
+    ticks = 0;
+    resetindex++;
+}
+
+void Simulation::newRun() {
+    held = false;
+
+    // decide which researches are applicable
+    locked = 0.0;
+    research = policy.research;
+    for(size_t i=0; i<research.size() && i<def->researchcost.size(); i+=1){
+        // block research if it is too expensive
+        if(exp >= 2*def->researchcost[i]){
+            research[i] = -1;
+            locked -= def->researchcost[i];
+        }
+    }
+
+    // reset non exp stats
+    def->resetGenerators(generators);
+    def->resetInfrastructure(infrastructure, citylevel, research);
+
+    // apply special researches
+    if(research.size()>1 && research[1]==1){
+        for(auto& g: generators){
+            g.mult = 1.001;
+        }
+    }
+    if(research.size()>3 && research[3]==1){
+        for(auto& g: generators){
+            const double draw = -std::log(uniformDraw(rngseed, resetindex, &g-generators.data()))/researchrate;
+            g.boni = std::min(draw,1000.0)+4;
+        }
+    }
+    if(research.size()>4 && research[4]==1){
+        research_mult = 2.0;
+    }else{
+        research_mult = 1.0;
+    }
+
+    runstarts.push_back({exp, citylevel});
+
+    if(logmode)
+        updateLogCache();
+}
+
+double Simulation::expGained() const {
+    return logmode ? logexpgain(logallgain) : expgain(allgain);
+}
+
+void Simulation::setLogMode(const bool on) {
+    if(on == logmode)
+        return;
+    logmode = on;
+    if(on){
+        logresource = std::log(resource);
+        logallgain = std::log(allgain);
+        updateLogCache();
+    }else{
+        resource = std::exp(logresource);
+        allgain = std::exp(logallgain);
+        inc = std::exp(loginc);
+    }
+}
+
+void Simulation::updateLogCache() {
+    // income, as in tickgain
+    double d = std::log(0.1);
+    for(size_t i=0; i<generators.size(); i++) {
+        double g = generators[i].loggain();
+        for(const auto& inf: infrastructure)
+            g += inf.logaffmult(i);
+        d = logadd(d, g);
+    }
+    loginc = d + std::log1p(expmul(exp,locked));
+
+    // candidates, as in buy: most costeffective generator and cheapest infrastructure
+    loggen = 0;
+    for(size_t i=1; i<generators.size(); i++)
+        if(generators[i].logeff() > generators[loggen].logeff())
+            loggen = i;
+    loginfra = 0;
+    for(size_t i=1; i<infrastructure.size(); i++)
+        if(infrastructure[i].logcost() < infrastructure[loginfra].logcost())
+            loginfra = i;
+}
+
+bool Simulation::buyLog() {
+    // Try to buy infrastructure
+    if(!infrastructure.empty() && infrastructure[loginfra].logcost() <= logresource) {
+        logresource = logsub(logresource, infrastructure[loginfra].logcost());
+        infrastructure[loginfra].buy();
+        updateLogCache();
+        return true;
+    }
+
+    // try to buy generator
+    if(generators[loggen].logcost() <= logresource) {
+        logresource = logsub(logresource, generators[loggen].logcost());
+        generators[loggen].buy();
+        updateLogCache();
+        return true;
+    }
+    return false;
+}
+
+void Simulation::run(const double toexp) {
+    if(held)
+        newRun();
+    do{
+        step();
+        if(held)
+            return;
+    }while(!panic && exp < toexp);
+}
+
+void Simulation::runUntilReset(const double toexp) {
+    if(held)
+        newRun();
+    while(!panic && exp < toexp && !step());
+}
+
+uint64_t Simulation::totalTicks() const {
+    return std::accumulate(resetlist.begin(), resetlist.end(), uint64_t(0));
+}
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gamedef.h"
+#include "generator.h"
+#include "lognum.h"
+#include "metrics.h"
+
+#ifndef IDLESIM_SIMULATION_H
+#define IDLESIM_SIMULATION_H
+
+/**
+ * Computes the gains per tick function.
+ * @tparam T
+ * @tparam S
+ * @param gens Generators to calculate income
+ * @param infra Infrastrucutre to buff generators
+ * @return
+ */
+template<typename T, typename S>
+double tickgain(const T& gens, const S& infra, const double expmul) {
+    double d = 0.1;
+    auto index = 0;
+    for(auto& g: gens) {
+        double mult = 1.0;
+        for(const auto& inf: infra)
+            mult *= inf.affmult(index);
+        d += g.gain()*mult;
+        index+=1;
+    }
+    return d*(1+expmul);
+}
+
+/**
+ * Decision function of which generator to buy with logging facility.
+ * An entry in a CSV (; separated) is created whenever a building is bought.
+ *  *
+ * @tparam T
+ * @tparam S
+ * @param gens Generators that are used
+ * @param infra Infrastructure in use
+ * @param resource Resource that is used to buy a generator
+ * @param ticks Current time of the game, used for logging only
+ * @param inc Current income of the game, used for logging only
+ * @param output logging facility, csv data is written to this ofstream
+ */
+template<typename T, typename S>
+bool buy(T& gens, S& infra, double& resource, const double ticks, const double inc){
+    // implement buy strategy
+    auto minG = std::min_element(gens.begin(), gens.end(), [](const auto& gen1, const auto& gen2) {
+        // cheapest
+        //return gen1.cost() < gen2.cost();
+
+        // most costeffective
+        return gen1.eff() > gen2.eff();
+    });
+    if(infra.size()>0) {
+        auto minI = std::min_element(infra.begin(), infra.end(), [](const auto &infra1, const auto &infra2) {
+            // cheapest
+            return infra1.cost() < infra2.cost();
+        });
+
+        // Try to buy infrastructure
+        if (minI->cost() <= resource) {
+            resource -= minI->cost();
+            minI->buy();
+
+            return true;
+        }
+    }
+
+    // try to buy generator
+    if(minG->cost() <= resource){
+        resource -= minG->cost();
+        minG->buy();
+
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Calculate part of the expgain and mult functions
+ *
+ * @param z
+ * @return exp(log/loglog)
+ */
+double calcstuff(const double z);
+
+/**
+ * computes multiplier from experience value
+ *
+ * @param experience
+ * @return mulitplier
+ */
+double expmul(const double experience, const double lockedexp);
+
+/**
+ * computes gain of experience for give resource value
+ *
+ * @param gained
+ * @return experience gained
+ */
+double expgain(const double gained);
+
+/**
+ * expgain for the log domain
+ *
+ * @param loggained log of the gained resource
+ * @return experience gained, same as expgain(exp(loggained)) where that does not overflow
+ */
+double logexpgain(const double loggained);
+
+/**
+ * Counter based random numbers: a draw is a hash of (seed, stream, counter), so it does not depend on
+ * any draws before it. The simulation uses one stream per reset, which makes every run reproducible on its own.
+ *
+ * @return uniform number in (0,1)
+ */
+double uniformDraw(uint64_t seed, uint64_t stream, uint64_t counter);
+
+/**
+ * Exp and city level at the start of a run, enough to simulate that run on its own (see Simulation::atRun).
+ */
+struct RunStart {
+    double exp;
+    int citylevel;
+};
+
+/**
+ * Decisions of a player that are not fixed by the game.
+ */
+struct Policy {
+    // level of the last generator needed for a reset
+    long resetlevel = 85;
+    // a reset needs to gain at least expfactor times the current exp
+    double expfactor = 1.0;
+    // research picked on every reset, blocked if it is too expensive
+    std::vector<int> research = {1, 0, 0, 1, 1};
+};
+
+/**
+ * Full state of a simulated game.
+ * The state is a plain copyable value, so a simulation can be forked at any point and the copies continued
+ * with different policies (see search.h). The game definition is shared and has to outlive all copies.
+ */
+class Simulation {
+    const GameDef* def;
+
+    // drawing for research, run i draws from stream i
+    uint64_t rngseed = 0;
+
+    // log domain, see setLogMode
+    bool logmode = false;
+    // income and the next candidates of buy only change on purchases, so they are cached
+    size_t loggen = 0;
+    size_t loginfra = 0;
+
+    // Recomputes log income and buy candidates
+    void updateLogCache();
+
+    // buy in the log domain, same decisions as buy
+    bool buyLog();
+
+public:
+    // Public because search, checkpoints and estimate read and write the state directly
+    Policy policy;
+    // progress dots are printed here if set
+    std::ostream* progress = &std::cout;
+    // collects run metrics if set and compiled with BASESIM_METRICS
+    SimMetrics* metrics = nullptr;
+    // stop after a reset without starting the next run, see newRun
+    bool holdreset = false;
+
+    // per run state, resets copy the templates of def into these without allocating
+    std::vector<Generator> generators;
+    std::vector<Infrastrucutre> infrastructure;
+    std::vector<int> research;
+    int citylevel = 0;
+    // Income
+    double inc = 0;
+    // Resource
+    double resource = 0;
+    double allgain = 0;
+    // logarithms of inc, resource and allgain, used instead of them in the log domain
+    double loginc = -INFINITY;
+    double logresource = -INFINITY;
+    double logallgain = -INFINITY;
+    // experience
+    double exp = 0;
+    double locked = 0.0;
+    double research_mult = 1.0;
+    // Time
+    uint64_t ticks = 0;
+    double allticks = 0;
+    std::vector<uint64_t> resetlist;
+    // start of every run, including the current one
+    std::vector<RunStart> runstarts;
+    // number of resets so far, selects the random stream of the current run
+    uint64_t resetindex = 0;
+    // reset happened but the next run was not started yet (only with holdreset)
+    bool held = false;
+    // resource went negative, simulation can not continue
+    bool panic = false;
+
+    Simulation(const GameDef& def, double startexp = 0, Policy policy = {});
+
+    // Simulates one tick, returns true if a reset happened
+    bool step();
+
+    // Steps until toexp is reached, runs at least one tick
+    void run(double toexp);
+
+    // Steps until the next reset or until toexp is reached
+    void runUntilReset(double toexp);
+
+    // Gains exp, advances the city level and clears the run, the next run is started by newRun
+    void reset();
+
+    // Starts the run after a reset: picks research with the current policy and regenerates generators and infrastructure
+    void newRun();
+
+    bool finished(double toexp) const { return panic || exp >= toexp; }
+
+    // Experience a reset would gain now
+    double expGained() const;
+
+    /**
+     * Switches the log domain on or off, converting the current resources.
+     * In the log domain resources, costs and gains are kept as logarithms, which are updated incrementally on purchases
+     * instead of calling pow, so runs far into the game neither overflow nor panic. Income only changes on purchases,
+     * so a tick is two log additions and cheaper than in the double domain.
+     * Decisions are the same as with doubles, up to rounding.
+     */
+    void setLogMode(bool on);
+
+    bool logMode() const { return logmode; }
+
+    // Seeds the research draws, unseeded simulations use seed 0
+    void seed(uint64_t seed) { rngseed = seed; }
+
+    uint64_t seedValue() const { return rngseed; }
+
+    /**
+     * State at the start of run index of a game, built without simulating the runs before.
+     * Runs only depend on their start, the policy and the seed, so this reproduces run index of the full game
+     * given its entry of runstarts.
+     */
+    static Simulation atRun(const GameDef& def, const Policy& policy, uint64_t seed, uint64_t index, const RunStart& start, bool logmode = false);
+
+    // total ticks of all finished runs, the value that is optimized
+    uint64_t totalTicks() const;
+};
+
+#endif //IDLESIM_SIMULATION_H
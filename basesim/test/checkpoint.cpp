@@ -0,0 +1,70 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+#include "gamedef.h"
+#include "server.h"
+#include "simulation.h"
+
+/**
+ * Checkpoint test: every scenario is interrupted a few times, saved, loaded and continued,
+ * which has to give the same resets as an uninterrupted run. All finished runs are then replayed on their own.
+ *
+ * Usage: basesim_checkpoint <gamefile> <checkpointfile>
+ */
+
+const std::vector<std::string> scenarios = {
+    "toexp=1e4",
+    "toexp=1e4 seed=7 numeric=log",
+    "toexp=3e4 resetlevel=75 seed=3",
+};
+
+Simulation start(const GameDef& def, const Scenario& scenario) {
+    Simulation sim(def, scenario.startexp, scenario.policy);
+    sim.progress = nullptr;
+    sim.seed(scenario.seed);
+    sim.setLogMode(scenario.logmode);
+    return sim;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 3) {
+        std::cerr << "usage: basesim_checkpoint <gamefile> <checkpointfile>" << std::endl;
+        return 2;
+    }
+    const std::string file = argv[2];
+
+    try {
+        const auto def = GameDef::load(argv[1]);
+        int failures = 0;
+        for(const auto& line: scenarios) {
+            const auto scenario = parseScenario(line);
+            auto expected = start(def, scenario);
+            expected.run(scenario.toexp);
+
+            // interrupt at odd ticks, so checkpoints fall in the middle of runs
+            auto sim = start(def, scenario);
+            int interruptions = 0;
+            while(!sim.finished(scenario.toexp)) {
+                for(int i=0; i<77777 && !sim.finished(scenario.toexp); i++)
+                    sim.step();
+                saveCheckpoint(sim, file);
+                sim = loadCheckpoint(def, file);
+                interruptions++;
+            }
+
+            const auto differing = verifyRuns(def, sim);
+            const bool ok = sim.resetlist == expected.resetlist && differing.empty();
+            failures += !ok;
+            std::cout << (ok ? "ok   " : "FAIL ") << line << ": " << interruptions << " checkpoints, "
+                      << sim.resetlist.size() << " resets, " << differing.size() << " replays differ" << std::endl;
+        }
+        std::remove(file.c_str());
+        return failures == 0 ? 0 : 1;
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+}
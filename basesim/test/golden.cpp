@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gamedef.h"
+#include "server.h"
+#include "simulation.h"
+
+/**
+ * Golden output test: runs every scenario of the golden file and compares its resets tick by tick.
+ * Pins the behaviour of the simulation, so changes to the engine can be shown to produce identical runs.
+ *
+ * Usage: basesim_golden <gamefile> <goldenfile> [--update]
+ * --update rewrites the golden file with the current results.
+ */
+
+std::vector<uint64_t> run(const GameDef& def, const Scenario& scenario) {
+    Simulation sim(def, scenario.startexp, scenario.policy);
+    sim.progress = nullptr;
+    if(scenario.seeded)
+        sim.seed(scenario.seed);
+    sim.setLogMode(scenario.logmode);
+    sim.run(scenario.toexp);
+    return sim.resetlist;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 3) {
+        std::cerr << "usage: basesim_golden <gamefile> <goldenfile> [--update]" << std::endl;
+        return 2;
+    }
+    const std::string goldenfile = argv[2];
+    const bool update = argc > 3 && std::string(argv[3]) == "--update";
+
+    try {
+        const auto def = GameDef::load(argv[1]);
+
+        std::ifstream in(goldenfile);
+        if(!in) {
+            std::cerr << "can not open " << goldenfile << std::endl;
+            return 2;
+        }
+
+        std::ostringstream updated;
+        int failures = 0;
+        int cases = 0;
+        std::string line;
+        while(std::getline(in, line)) {
+            const auto bar = line.find('|');
+            if(line.empty() || line[0] == '#' || bar == std::string::npos) {
+                updated << line << std::endl;
+                continue;
+            }
+
+            const auto scenario = line.substr(0, bar);
+            std::vector<uint64_t> expected;
+            std::istringstream strs(line.substr(bar+1));
+            for(uint64_t ticks; strs >> ticks;)
+                expected.push_back(ticks);
+
+            const auto actual = run(def, parseScenario(scenario));
+            cases++;
+
+            updated << scenario << "|";
+            for(auto ticks: actual)
+                updated << " " << ticks;
+            updated << std::endl;
+
+            if(actual != expected) {
+                failures++;
+                std::cout << "FAIL " << scenario << std::endl;
+                for(size_t i=0; i<std::max(actual.size(), expected.size()); i++) {
+                    if(i >= actual.size() || i >= expected.size() || actual[i] != expected[i]) {
+                        std::cout << "  first difference at reset " << i << ": expected "
+                                  << (i < expected.size() ? std::to_string(expected[i]) : "none") << ", got "
+                                  << (i < actual.size() ? std::to_string(actual[i]) : "none") << std::endl;
+                        break;
+                    }
+                }
+            }else{
+                std::cout << "ok   " << scenario << std::endl;
+            }
+        }
+
+        if(update) {
+            std::ofstream out(goldenfile);
+            out << updated.str();
+            std::cout << "updated " << goldenfile << std::endl;
+            return 0;
+        }
+
+        std::cout << cases-failures << " of " << cases << " golden runs match" << std::endl;
+        return failures == 0 && cases > 0 ? 0 : 1;
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+}